@@ -78,17 +78,68 @@ namespace Signature
 			};
 
 		public:
+			static constexpr uint32_t initial = 0xFFFFFFFF;
+
+			/**
+			 * Incremental form: start from initial, feed the data piece by piece and
+			 * finalize the state once the whole message has been seen.
+			*/
 			template <typename T>
-			static constexpr uint32_t calculate( const T* data, size_t length )
+			static constexpr uint32_t update( uint32_t crc, const T* data, size_t length )
 			{
-				uint32_t crc = 0xFFFFFFFF;
-
 				while ( length-- )
 					crc = ( crc >> 8 ) ^ crc32Table[( crc ^ *data++ ) & 0xFF];
 
+				return crc;
+			}
+
+			static constexpr uint32_t finalize( uint32_t crc )
+			{
 				return crc ^ 0xFFFFFFFF;
 			}
 
+			template <typename T>
+			static constexpr uint32_t calculate( const T* data, size_t length )
+			{
+				return finalize( update( initial, data, length ) );
+			}
+
+			/**
+			 * Hashes blockCount consecutive blocks of blockSize bytes each. Four blocks are
+			 * walked side by side, their independent table lookups overlap in the pipeline.
+			*/
+			template <typename T>
+			static void calculate( const T* data, size_t blockSize, size_t blockCount, uint32_t* hashSums )
+			{
+				size_t idx = 0;
+				for ( ; idx + 4 <= blockCount; idx += 4 )
+				{
+					const T* lane0 = data + idx * blockSize;
+					const T* lane1 = lane0 + blockSize;
+					const T* lane2 = lane1 + blockSize;
+					const T* lane3 = lane2 + blockSize;
+
+					uint32_t crc0 = initial, crc1 = initial, crc2 = initial, crc3 = initial;
+					for ( size_t pos = 0; pos < blockSize; ++pos )
+					{
+						crc0 = ( crc0 >> 8 ) ^ crc32Table[( crc0 ^ lane0[pos] ) & 0xFF];
+						crc1 = ( crc1 >> 8 ) ^ crc32Table[( crc1 ^ lane1[pos] ) & 0xFF];
+						crc2 = ( crc2 >> 8 ) ^ crc32Table[( crc2 ^ lane2[pos] ) & 0xFF];
+						crc3 = ( crc3 >> 8 ) ^ crc32Table[( crc3 ^ lane3[pos] ) & 0xFF];
+					}
+
+					hashSums[idx] = finalize( crc0 );
+					hashSums[idx + 1] = finalize( crc1 );
+					hashSums[idx + 2] = finalize( crc2 );
+					hashSums[idx + 3] = finalize( crc3 );
+				}
+
+				for ( ; idx < blockCount; ++idx )
+				{
+					hashSums[idx] = calculate( data + idx * blockSize, blockSize );
+				}
+			}
+
 			template <typename T>
 			static constexpr uint32_t calculate( const std::vector<T>& data )
 			{
@@ -0,0 +1,83 @@
+#include "Client.hpp"
+#include "Protocol.hpp"
+
+#if !defined( _WIN32 )
+
+#include <cerrno>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace Signature
+{
+	namespace Service
+	{
+		Client::Client( const std::filesystem::path& socketPath ) :
+			socket_( UnixSocket::connect( socketPath ) )
+		{
+		}
+
+		void Client::sign( const std::filesystem::path& inFilePath, const std::filesystem::path& outFilePath, size_t blockSize, bool passDescriptor )
+		{
+			Protocol::message_t request;
+			request[Protocol::blockSize] = std::to_string( blockSize );
+			request[Protocol::algorithm] = Protocol::defaultAlgorithm;
+
+			std::vector<int> descriptors;
+			int inDescriptor = -1;
+
+			if ( passDescriptor )
+			{
+				inDescriptor = ::open( inFilePath.c_str(), O_RDONLY );
+				if ( inDescriptor < 0 )
+				{
+					throw std::system_error( errno, std::generic_category(), "can't open input file" );
+				}
+
+				request[Protocol::inputDescriptor] = std::to_string( descriptors.size() );
+				descriptors.push_back( inDescriptor );
+			}
+			else
+			{
+				//The daemon doesn't share our working directory
+				request[Protocol::input] = std::filesystem::absolute( inFilePath ).string();
+			}
+
+			//"-" has the daemon stream the signature into our standard output
+			if ( outFilePath == "-" )
+			{
+				request[Protocol::outputDescriptor] = std::to_string( descriptors.size() );
+				descriptors.push_back( STDOUT_FILENO );
+			}
+			else
+			{
+				request[Protocol::output] = std::filesystem::absolute( outFilePath ).string();
+			}
+
+			try
+			{
+				socket_.send( Protocol::encode( request ), descriptors );
+			}
+			catch ( ... )
+			{
+				if ( inDescriptor >= 0 )
+					::close( inDescriptor );
+
+				throw;
+			}
+
+			if ( inDescriptor >= 0 )
+				::close( inDescriptor );
+
+			Protocol::message_t reply = Protocol::decode( socket_.receive() );
+			if ( Protocol::field( reply, Protocol::status ) != Protocol::statusOk )
+			{
+				auto message = reply.find( Protocol::message );
+				throw std::runtime_error( message != reply.end() ? message->second : "daemon failed to sign the file" );
+			}
+		}
+	} // namespace Service
+} // namespace Signature
+
+#endif // !_WIN32
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Socket.hpp"
+
+#include <filesystem>
+
+namespace Signature
+{
+	namespace Service
+	{
+		/**
+		 * Sends signing requests to a running Daemon.
+		*/
+		class Client final
+		{
+		public:
+			explicit Client( const std::filesystem::path& socketPath );
+
+			/**
+			 * Blocks until the daemon has written the signature, throws on failure. When
+			 * passDescriptor is set the input is opened here and handed over to the daemon,
+			 * an output of "-" hands over the standard output.
+			*/
+			void sign( const std::filesystem::path& inFilePath, const std::filesystem::path& outFilePath, size_t blockSize, bool passDescriptor );
+
+		private:
+			UnixSocket socket_;
+		};
+	} // namespace Service
+} // namespace Signature
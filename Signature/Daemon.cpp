@@ -0,0 +1,256 @@
+#include "Daemon.hpp"
+#include "Protocol.hpp"
+
+#if !defined( _WIN32 )
+
+#include <cerrno>
+#include <ostream>
+#include <algorithm>
+#include <system_error>
+
+#include <poll.h>
+#include <unistd.h>
+
+namespace Signature
+{
+	namespace Service
+	{
+		namespace
+		{
+			//Unlike std::stoull alone, rejects a sign and anything trailing the digits
+			size_t parseNumber( const std::string& value, const char* key )
+			{
+				if ( value.empty() || !std::all_of( value.begin(), value.end(), []( char c ) { return c >= '0' && c <= '9'; } ) )
+				{
+					throw std::invalid_argument( std::string( "'" ) + key + "' isn't a number" );
+				}
+
+				try
+				{
+					return std::stoull( value );
+				}
+				catch ( const std::out_of_range& )
+				{
+					throw std::invalid_argument( std::string( "'" ) + key + "' is out of range" );
+				}
+			}
+
+			//Failures of a single connection or a momentary shortage of descriptors, memory or
+			//threads, the listener itself is fine
+			bool isTransient( const std::system_error& error )
+			{
+				if ( error.code().category() != std::generic_category() )
+					return false;
+
+				switch ( error.code().value() )
+				{
+					case ECONNABORTED:
+					case EPROTO:
+					case EPERM:
+					case EMFILE:
+					case ENFILE:
+					case ENOBUFS:
+					case ENOMEM:
+					case EAGAIN:
+						return true;
+
+					default:
+						return false;
+				}
+			}
+
+			//Closes the descriptors received from a client once the request is served
+			struct descriptor_guard_t
+			{
+				std::vector<int> descriptors;
+
+				~descriptor_guard_t()
+				{
+					for ( int descriptor : descriptors )
+						::close( descriptor );
+				}
+
+				int at( const Protocol::message_t& request, const char* key ) const
+				{
+					size_t idx = parseNumber( Protocol::field( request, key ), key );
+					if ( idx >= descriptors.size() )
+					{
+						throw std::invalid_argument( std::string( "descriptor for '" ) + key + "' wasn't passed" );
+					}
+
+					return descriptors[idx];
+				}
+			};
+		} // namespace
+
+		Daemon::Daemon( const std::filesystem::path& socketPath, size_t maxMemory, size_t readerCount ) :
+			socketPath_( socketPath ), worker_( maxMemory, readerCount ), listener_( UnixSocket::listen( socketPath ) )
+		{
+			if ( ::pipe( stopPipe_ ) < 0 )
+			{
+				throw std::system_error( errno, std::generic_category(), "pipe" );
+			}
+		}
+
+		Daemon::~Daemon()
+		{
+			for ( std::future<void>& session : sessions_ )
+			{
+				session.wait();
+			}
+
+			listener_.close();
+
+			//Nothing to be done about a failure here, the next daemon removes a stale socket anyway
+			std::error_code error;
+			std::filesystem::remove( socketPath_, error );
+
+			for ( int descriptor : stopPipe_ )
+			{
+				if ( descriptor >= 0 )
+					::close( descriptor );
+			}
+		}
+
+		void Daemon::stop()
+		{
+			char signal = 0;
+			while ( ::write( stopPipe_[1], &signal, sizeof( signal ) ) < 0 && errno == EINTR )
+				continue;
+		}
+
+		void Daemon::run()
+		{
+			pollfd descriptors[] = {
+				{ listener_.descriptor(), POLLIN, 0 },
+				{ stopPipe_[0], POLLIN, 0 }
+			};
+
+			bool backingOff = false;
+			while ( true )
+			{
+				//With every session busy new clients wait in the listen backlog
+				reapSessions();
+				const bool sessionsFull = sessions_.size() >= maxSessions;
+
+				//Pending connections stay queued while paused, poll() skips a negative descriptor
+				int timeout = -1;
+				if ( backingOff )
+					timeout = acceptRetryInterval;
+				else if ( sessionsFull )
+					timeout = sessionPollInterval;
+
+				descriptors[0].fd = timeout < 0 ? listener_.descriptor() : -1;
+
+				if ( ::poll( descriptors, 2, timeout ) < 0 )
+				{
+					if ( errno == EINTR )
+						continue;
+
+					throw std::system_error( errno, std::generic_category(), "poll" );
+				}
+
+				backingOff = false;
+
+				if ( descriptors[1].revents )
+					break;
+
+				if ( descriptors[0].revents & POLLIN )
+				{
+					try
+					{
+						sessions_.push_back( std::async( std::launch::async, &Daemon::serve, this, listener_.accept() ) );
+					}
+					catch ( const std::system_error& e )
+					{
+						if ( !isTransient( e ) )
+							throw;
+
+						//Retrying at once would spin on a listener that stays readable
+						backingOff = true;
+					}
+				}
+			}
+
+			for ( std::future<void>& session : sessions_ )
+			{
+				session.get();
+			}
+
+			sessions_.clear();
+
+			if ( worker_.interrupted() )
+			{
+				throw std::runtime_error( "signing pipeline is interrupted" );
+			}
+		}
+
+		void Daemon::reapSessions()
+		{
+			sessions_.remove_if( []( std::future<void>& session ) { return session.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready; } );
+		}
+
+		void Daemon::serve( UnixSocket connection )
+		try
+		{
+			Protocol::message_t reply;
+
+			try
+			{
+				descriptor_guard_t passed;
+				Protocol::message_t request = Protocol::decode( connection.receive( &passed.descriptors, stopPipe_[0], requestTimeout ) );
+
+				auto algorithm = request.find( Protocol::algorithm );
+				if ( algorithm != request.end() && algorithm->second != Protocol::defaultAlgorithm )
+				{
+					throw std::invalid_argument( "unsupported algorithm '" + algorithm->second + "'" );
+				}
+
+				FileReader input;
+				if ( request.count( Protocol::inputDescriptor ) )
+				{
+					//Read through the client's descriptor, the daemon may have no access to the path
+					input.open( passed.at( request, Protocol::inputDescriptor ) );
+				}
+				else
+				{
+					input.open( std::filesystem::path( Protocol::field( request, Protocol::input ) ) );
+				}
+
+				size_t blockSize = parseNumber( Protocol::field( request, Protocol::blockSize ), Protocol::blockSize );
+				if ( request.count( Protocol::outputDescriptor ) )
+				{
+					DescriptorOutput buffer( passed.at( request, Protocol::outputDescriptor ), stopPipe_[0] );
+					std::ostream output( &buffer );
+
+					worker_.submit( std::move( input ), output, blockSize ).get();
+				}
+				else
+				{
+					worker_.submit( std::move( input ), Protocol::field( request, Protocol::output ), blockSize ).get();
+				}
+
+				reply[Protocol::status] = Protocol::statusOk;
+			}
+			catch ( const std::exception& e )
+			{
+				reply[Protocol::status] = Protocol::statusError;
+				reply[Protocol::message] = e.what();
+			}
+
+			//Every later request would fail the same way, let the daemon exit instead
+			if ( worker_.interrupted() )
+			{
+				stop();
+			}
+
+			connection.send( Protocol::encode( reply ) );
+		}
+		catch ( ... )
+		{
+			//The client is gone, nobody to report to
+		}
+	} // namespace Service
+} // namespace Signature
+
+#endif // !_WIN32
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Signature.hpp"
+#include "Socket.hpp"
+
+#include <list>
+#include <future>
+#include <filesystem>
+
+namespace Signature
+{
+	namespace Service
+	{
+		/**
+		 * Keeps one MainWorker warm and signs files on behalf of clients connecting to a
+		 * Unix domain socket. Every connection carries one request, requests share the
+		 * pipeline and are read in turns.
+		*/
+		class Daemon final
+		{
+		public:
+			Daemon( const std::filesystem::path& socketPath, size_t maxMemory, size_t readerCount );
+			~Daemon();
+
+			/**
+			 * Serves clients until stop() is called, then waits for the running requests. Clients
+			 * that haven't sent their request yet are dropped. Throws if it stopped because the
+			 * signing pipeline broke down.
+			*/
+			void run();
+
+			/**
+			 * Async-signal-safe, may be called from a signal handler.
+			*/
+			void stop();
+
+		private:
+			const std::filesystem::path socketPath_;
+
+			MainWorker worker_;
+			UnixSocket listener_;
+
+			//Self-pipe waking up the accept loop and the sessions waiting for a request on stop()
+			int stopPipe_[2] = { -1, -1 };
+
+			//A client that connects and stays silent doesn't hold a session for longer
+			static constexpr int requestTimeout = 30000; // 30 sec
+			static constexpr int acceptRetryInterval = 100; // 100 msec
+
+			//Every session is a thread, at most this many requests are served at once
+			static constexpr size_t maxSessions = 64;
+			static constexpr int sessionPollInterval = 10; // 10 msec
+
+			std::list<std::future<void>> sessions_;
+
+			void serve( UnixSocket connection );
+			void reapSessions();
+
+			Daemon( const Daemon& ) = delete;
+			Daemon& operator=( const Daemon& ) = delete;
+		};
+	} // namespace Service
+} // namespace Signature
@@ -1,6 +1,18 @@
 #include "FileReader.hpp"
 
 #include <cassert>
+#include <cerrno>
+#include <algorithm>
+#include <system_error>
+
+#if defined( _WIN32 )
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif // _WIN32
 
 namespace Signature
 {
@@ -9,32 +21,157 @@ namespace Signature
 		open( filePath );
 	}
 
+	FileReader::FileReader( FileReader&& other ) noexcept :
+		fileSize_( other.fileSize_ )
+	{
+#if defined( _WIN32 )
+		handle_ = other.handle_;
+		other.handle_ = nullptr;
+#else
+		descriptor_ = other.descriptor_;
+		other.descriptor_ = -1;
+#endif // _WIN32
+	}
+
 	bool FileReader::open( const std::filesystem::path& filePath )
 	{
-		stream_.exceptions( std::ifstream::badbit | std::ifstream::failbit );
-		stream_.open( filePath, std::ios_base::in | std::ios_base::binary );
+		close();
+
+#if defined( _WIN32 )
+		//Reads on a synchronous handle are serialized by the system, an overlapped one serves
+		//every reader thread at once. A file still being written by others can be read too.
+		handle_ = ::CreateFileW( filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr );
+		if ( handle_ == INVALID_HANDLE_VALUE )
+		{
+			handle_ = nullptr;
+			throw std::system_error( static_cast<int>( ::GetLastError() ), std::system_category(), "can't open input file" );
+		}
+#else
+		descriptor_ = ::open( filePath.c_str(), O_RDONLY );
+		if ( descriptor_ < 0 )
+		{
+			throw std::system_error( errno, std::generic_category(), "can't open input file" );
+		}
+#endif // _WIN32
+
 		fileSize_ = std::filesystem::file_size( filePath );
 
-		return stream_.is_open();
+		return true;
 	}
 
-	void FileReader::read( buffer_t& buffer )
+#if !defined( _WIN32 )
+	bool FileReader::open( int descriptor )
 	{
-		assert( stream_.is_open() );
-		assert( buffer.size() );
+		close();
+
+		descriptor_ = ::fcntl( descriptor, F_DUPFD_CLOEXEC, 0 );
+		if ( descriptor_ < 0 )
+		{
+			throw std::system_error( errno, std::generic_category(), "can't open input file" );
+		}
 
-		size_t readSize = buffer.size();
-		if ( readSize > fileSize_ - stream_.tellg() )
-			readSize = fileSize_ - stream_.tellg();
+		struct stat status = {};
+		if ( ::fstat( descriptor_, &status ) < 0 )
+		{
+			throw std::system_error( errno, std::generic_category(), "can't open input file" );
+		}
 
-		stream_.read( reinterpret_cast<char*>( buffer.data() ), readSize );
+		//Blocks are read by offset, a pipe can't serve that
+		if ( !S_ISREG( status.st_mode ) )
+		{
+			throw std::invalid_argument( "input file isn't a regular file" );
+		}
+
+		fileSize_ = static_cast<uintmax_t>( status.st_size );
+
+		return true;
 	}
+#endif // !_WIN32
 
-	FileReader::~FileReader()
+	size_t FileReader::read( uint8_t* data, size_t size, uintmax_t offset ) const
 	{
-		if ( stream_.is_open() )
+		if ( offset >= fileSize_ )
+			return 0;
+
+		size_t readSize = size;
+		if ( readSize > fileSize_ - offset )
+			readSize = static_cast<size_t>( fileSize_ - offset );
+
+		//A single call may return less than asked for, keep reading until the range is filled
+		for ( size_t done = 0; done < readSize; )
 		{
-			stream_.close();
+#if defined( _WIN32 )
+			assert( handle_ );
+
+			OVERLAPPED position = {};
+			position.Offset = static_cast<DWORD>( offset + done );
+			position.OffsetHigh = static_cast<DWORD>( ( offset + done ) >> 32 );
+
+			//Every read waits on its own event, the handle is signaled by any of them
+			position.hEvent = ::CreateEventW( nullptr, TRUE, FALSE, nullptr );
+			if ( !position.hEvent )
+			{
+				throw std::system_error( static_cast<int>( ::GetLastError() ), std::system_category(), "can't read input file" );
+			}
+
+			DWORD received = 0;
+			const DWORD request = static_cast<DWORD>( std::min<size_t>( readSize - done, 1u << 30 ) );
+			BOOL succeeded = ::ReadFile( handle_, data + done, request, nullptr, &position );
+			if ( succeeded || ::GetLastError() == ERROR_IO_PENDING )
+			{
+				succeeded = ::GetOverlappedResult( handle_, &position, &received, TRUE );
+			}
+
+			const DWORD error = ::GetLastError();
+			::CloseHandle( position.hEvent );
+
+			if ( !succeeded && error != ERROR_HANDLE_EOF )
+			{
+				throw std::system_error( static_cast<int>( error ), std::system_category(), "can't read input file" );
+			}
+#else
+			assert( descriptor_ >= 0 );
+
+			ssize_t received = ::pread( descriptor_, data + done, readSize - done, static_cast<off_t>( offset + done ) );
+			if ( received < 0 )
+			{
+				if ( errno == EINTR )
+					continue;
+
+				throw std::system_error( errno, std::generic_category(), "can't read input file" );
+			}
+#endif // _WIN32
+
+			if ( !received )
+			{
+				throw std::runtime_error( "input file was truncated while reading" );
+			}
+
+			done += static_cast<size_t>( received );
 		}
+
+		return readSize;
+	}
+
+	void FileReader::close()
+	{
+#if defined( _WIN32 )
+		if ( handle_ )
+		{
+			::CloseHandle( handle_ );
+			handle_ = nullptr;
+		}
+#else
+		if ( descriptor_ >= 0 )
+		{
+			::close( descriptor_ );
+			descriptor_ = -1;
+		}
+#endif // _WIN32
+	}
+
+	FileReader::~FileReader()
+	{
+		close();
 	}
 } // namespace Signature
@@ -2,28 +2,51 @@
 
 #include "types.hpp"
 
-#include <fstream>
 #include <filesystem>
 
 namespace Signature
 {
+	/**
+	 * Positional reader over a native file handle. There is no shared stream position,
+	 * so any number of threads may read from one instance at the same time.
+	*/
 	class FileReader final
 	{
 	public:
 		FileReader() = default;
 		FileReader( const std::filesystem::path& filePath );
+		FileReader( FileReader&& other ) noexcept;
 		~FileReader();
 
 		bool open( const std::filesystem::path& filePath );
-		void read( buffer_t& buffer );
+
+#if !defined( _WIN32 )
+		/**
+		 * Reads a file opened by somebody else, e.g. a descriptor passed by a client. The
+		 * descriptor is duplicated, the caller keeps its own copy.
+		*/
+		bool open( int descriptor );
+#endif // !_WIN32
+
+		/**
+		 * Reads from an absolute offset, returns the number of bytes available there.
+		*/
+		size_t read( uint8_t* data, size_t size, uintmax_t offset ) const;
 
 		uintmax_t fileSize() const { return fileSize_; }
 
 	private:
-		uintmax_t fileSize_;
-		std::ifstream stream_;
+		uintmax_t fileSize_ = 0;
+
+#if defined( _WIN32 )
+		void* handle_ = nullptr;
+#else
+		int descriptor_ = -1;
+#endif // _WIN32
+
+		void close();
 
 		FileReader( const FileReader& ) = delete;
-		FileReader( FileReader&& ) = delete;
+		FileReader& operator=( const FileReader& ) = delete;
 	};
 } // namespace Signature
@@ -1,6 +1,7 @@
 #include "FileWriter.hpp"
 
 #include <cassert>
+#include <stdexcept>
 
 namespace Signature
 {
@@ -9,28 +10,59 @@ namespace Signature
 		open( filePath );
 	}
 
+	FileWriter::FileWriter( std::ostream& stream ) :
+		stream_( &stream ), seekable_( false )
+	{
+	}
+
 	bool FileWriter::open( const std::filesystem::path& filePath )
 	{
-		stream_.exceptions( std::ifstream::badbit | std::ifstream::failbit );
-		stream_.open( filePath, std::ios_base::out | std::ios_base::binary );
+		//A named pipe or a device may be opened as well, it just can't be written out of order
+		seekable_ = !std::filesystem::exists( filePath ) || std::filesystem::is_regular_file( filePath );
 
-		return stream_.is_open();
+		file_.exceptions( std::ifstream::badbit | std::ifstream::failbit );
+		file_.open( filePath, std::ios_base::out | std::ios_base::binary );
+
+		return file_.is_open();
 	}
 
 	void FileWriter::write( const result_data_t& data )
 	{
-		static constexpr size_t dataSize = sizeof( data.hashSum );
+		static constexpr size_t dataSize = sizeof( uint32_t );
 
-		assert( stream_.is_open() );
-		stream_.seekp( data.blockIndex * dataSize, std::ios_base::beg );
-		stream_.write( reinterpret_cast<const char*>( &data.hashSum ), dataSize );
+		assert( file_.is_open() && seekable_ );
+		file_.seekp( data.blockIndex * dataSize, std::ios_base::beg );
+		file_.write( reinterpret_cast<const char*>( data.hashSums.data() ), data.hashSums.size() * dataSize );
+	}
+
+	void FileWriter::append( const std::vector<uint32_t>& hashSums )
+	{
+		stream_->write( reinterpret_cast<const char*>( hashSums.data() ), hashSums.size() * sizeof( uint32_t ) );
+
+		//A caller's stream keeps its own exception mask
+		if ( !*stream_ )
+		{
+			throw std::runtime_error( "failed to write the signature" );
+		}
+	}
+
+	void FileWriter::close()
+	{
+		if ( file_.is_open() )
+		{
+			file_.close();
+		}
+		else if ( stream_ != &file_ && !stream_->flush() )
+		{
+			throw std::runtime_error( "failed to write the signature" );
+		}
 	}
 
 	FileWriter::~FileWriter()
 	{
-		if ( stream_.is_open() )
+		if ( file_.is_open() )
 		{
-			stream_.close();
+			file_.close();
 		}
 	}
 } // namespace Signature
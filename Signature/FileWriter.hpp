@@ -12,13 +12,28 @@ namespace Signature
 	public:
 		FileWriter() = default;
 		FileWriter( const std::filesystem::path& filePath ); 
+
+		/**
+		 * Writes into a stream owned by the caller, e.g. std::cout or a socket. Such an
+		 * output is never seekable, results have to be appended in order.
+		*/
+		explicit FileWriter( std::ostream& stream );
 		~FileWriter();
 
 		bool open( const std::filesystem::path& filePath );
 		void write( const result_data_t& data );
+		void append( const std::vector<uint32_t>& hashSums );
+		void close();
+
+		/**
+		 * False for pipes, sockets and character devices.
+		*/
+		bool seekable() const { return seekable_; }
 
 	private:
-		std::ofstream stream_;
+		std::ofstream file_;
+		std::ostream* stream_ = &file_;
+		bool seekable_ = true;
 	};
 }
 
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+
+namespace Signature
+{
+	namespace Service
+	{
+		/**
+		 * Daemon wire format: one "key=value" pair per line. A request names the input and
+		 * the output, each either a path or the index of a descriptor passed with the
+		 * message, the block size and the algorithm; the reply carries a status and an
+		 * optional message. A passed output gets the signature streamed in order.
+		*/
+		class Protocol
+		{
+		public:
+			using message_t = std::map<std::string, std::string>;
+
+			static constexpr const char* input = "input";
+			static constexpr const char* inputDescriptor = "input-fd";
+			static constexpr const char* output = "output";
+			static constexpr const char* outputDescriptor = "output-fd";
+			static constexpr const char* blockSize = "block-size";
+			static constexpr const char* algorithm = "algorithm";
+			static constexpr const char* status = "status";
+			static constexpr const char* message = "message";
+
+			static constexpr const char* statusOk = "ok";
+			static constexpr const char* statusError = "error";
+			static constexpr const char* defaultAlgorithm = "crc32";
+
+			static std::string encode( const message_t& fields )
+			{
+				std::string data;
+				for ( const auto& [key, value] : fields )
+				{
+					if ( key.find_first_of( "=\n" ) != std::string::npos || value.find( '\n' ) != std::string::npos )
+					{
+						throw std::invalid_argument( "field '" + key + "' can't be encoded" );
+					}
+
+					data += key + '=' + value + '\n';
+				}
+
+				//The socket terminates the message with an empty line
+				if ( !data.empty() )
+					data.pop_back();
+
+				return data;
+			}
+
+			static message_t decode( const std::string& data )
+			{
+				message_t fields;
+				std::istringstream stream( data );
+
+				for ( std::string line; std::getline( stream, line ); )
+				{
+					size_t separator = line.find( '=' );
+					if ( separator == std::string::npos )
+					{
+						throw std::invalid_argument( "malformed line '" + line + "'" );
+					}
+
+					fields[line.substr( 0, separator )] = line.substr( separator + 1 );
+				}
+
+				return fields;
+			}
+
+			static const std::string& field( const message_t& fields, const char* key )
+			{
+				auto it = fields.find( key );
+				if ( it == fields.end() )
+				{
+					throw std::invalid_argument( std::string( "missing field '" ) + key + "'" );
+				}
+
+				return it->second;
+			}
+		};
+	} // namespace Service
+} // namespace Signature
@@ -45,9 +45,10 @@ namespace Signature
 
 			/**
 			 * Pops and element off the front of the queue - this is thread-safe and there can
-			 * be multiple readers.
+			 * be multiple readers. The element is moved out before the slot is released, so a
+			 * concurrent push can never overwrite it.
 			*/
-			T&& pop();
+			T pop();
 
 			/**
 			 * Reports if there are any elements currently in the queue - ephemeral if
@@ -141,7 +142,7 @@ namespace Signature
 		 * Pop and element off the queue
 		*/
 		template <class T>
-		T&& FastCircularQueue<T>::pop()
+		T FastCircularQueue<T>::pop()
 		{
 			while ( true )
 			{
@@ -165,14 +166,16 @@ namespace Signature
 						continue;
 					}
 
+					//Fetch the value from the buffer while the slot is still owned
+					T element = std::move( buffer_[currentReadIdx] );
+
 					//Decrement the count - this must be atomic and come before
 					--count_;
 
 					//Calculate a new read index - does not have to be atomic
 					readIdx_ = ( currentReadIdx + 1 ) % bufferSize_;
 
-					//Fetch the value from the buffer
-					return std::move( buffer_[currentReadIdx] );
+					return element;
 				}
 				else
 				{
@@ -180,7 +183,7 @@ namespace Signature
 				}
 			}
 
-			return std::move( T() );
+			return T();
 		}
 
 		/*
@@ -1,37 +1,150 @@
 #include "Signature.hpp"
-#include "FileReader.hpp"
-#include "FileWriter.hpp"
 #include "CRC32.hpp"
 
 #include <cassert>
+#include <iostream>
+#include <algorithm>
 
 namespace Signature
 {
-	MainWorker::MainWorker( const std::filesystem::path& inFilePath, const std::filesystem::path& outFilePath, size_t blockSize ) :
-		inFilePath_( inFilePath ), outFilePath_( outFilePath ), blockSize_( blockSize )
+	job_data_t::job_data_t( FileReader&& input, const std::filesystem::path& outFilePath, size_t blockSize ) :
+		reader( std::move( input ) ), writer( outFilePath ), blockSize( blockSize ), ordered( !writer.seekable() )
 	{
-		if ( !std::filesystem::exists( inFilePath ) )
+		blockCount = reader.fileSize() / blockSize + ( reader.fileSize() % blockSize > 0 );
+	}
+
+	job_data_t::job_data_t( FileReader&& input, std::ostream& output, size_t blockSize ) :
+		reader( std::move( input ) ), writer( output ), blockSize( blockSize ), ordered( true )
+	{
+		blockCount = reader.fileSize() / blockSize + ( reader.fileSize() % blockSize > 0 );
+	}
+
+	void job_data_t::fail( std::exception_ptr error )
+	{
+		std::lock_guard<std::mutex> lock( errorMutex_ );
+		if ( !error_ )
 		{
-			throw std::invalid_argument( "input file doesn't exist" );
+			error_ = error;
 		}
 
-		if ( !std::filesystem::exists( outFilePath.parent_path() ) )
+		failed_.store( true, std::memory_order_relaxed );
+	}
+
+	void job_data_t::retain()
+	{
+		++pendingCount_;
+	}
+
+	void job_data_t::release()
+	{
+		if ( --pendingCount_ == 0 )
 		{
-			throw std::invalid_argument( "output directory doesn't exist" );
+			if ( !ordered )
+			{
+				complete();
+				return;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock( readyMutex );
+				handedOver = true;
+			}
+
+			readyChanged.notify_all();
 		}
+	}
+
+	void job_data_t::complete()
+	{
+		try
+		{
+			//Flush the signature before anybody waiting on the job looks at it
+			writer.close();
+		}
+		catch ( ... )
+		{
+			fail( std::current_exception() );
+		}
+
+		finish();
+	}
+
+	void job_data_t::abort( std::exception_ptr error )
+	{
+		//The writer thread may still own a file output, leave it to the destructor. An ordered
+		//output belongs to the drain, which gives up once it sees the failure.
+		fail( error );
 
-		if ( !blockSize )
+		{
+			std::lock_guard<std::mutex> lock( readyMutex );
+		}
+
+		readyChanged.notify_all();
+		finish();
+	}
+
+	void job_data_t::finish()
+	{
+		if ( finished_.exchange( true ) )
+			return;
+
+		std::lock_guard<std::mutex> lock( errorMutex_ );
+		if ( error_ )
+		{
+			done_.set_exception( error_ );
+		}
+		else
+		{
+			done_.set_value();
+		}
+	}
+
+	MainWorker::MainWorker( size_t maxMemory, size_t readerCount ) :
+		chunkSize_( maxChunkSize ), maxMemory_( maxMemory ), readerCount_( readerCount )
+	{
+		startWorkers();
+	}
+
+	MainWorker::MainWorker( const std::filesystem::path& inFilePath, const std::filesystem::path& outFilePath, size_t blockSize, size_t maxMemory, size_t readerCount ) :
+		inFilePath_( inFilePath ), outFilePath_( outFilePath ), blockSize_( blockSize ),
+		chunkSize_( blockSize < minBatchSize ? minBatchSize / blockSize * blockSize : std::min( blockSize, maxChunkSize ) ), maxMemory_( maxMemory ),
+		readerCount_( readerCount )
+	{
+		startWorkers();
+	}
+
+	void MainWorker::startWorkers()
+	{
+		if ( !chunkSize_ )
 		{
 			throw std::invalid_argument( "Block size is zero" );
 		}
 
+		if ( !readerCount_ )
+		{
+			throw std::invalid_argument( "Reader count is zero" );
+		}
+
 		maxThreadPool_ = std::thread::hardware_concurrency();
 		if ( !maxThreadPool_ )
 		{
 			maxThreadPool_ = defaultThreadCount;
 		}
 
-		maxPoolDataZize_ = maxThreadPool_ * 2;
+		//The pipeline needs two chunks at least, a smaller budget gets smaller chunks and the
+		//blocks that don't fit are streamed
+		if ( maxMemory_ / chunkSize_ < 2 )
+		{
+			chunkSize_ = maxMemory_ / 2;
+		}
+
+		if ( chunkSize_ < minBlockSize )
+		{
+			throw std::invalid_argument( "Memory budget is too small" );
+		}
+
+		//The budget decides how many chunks are resident, more than two per thread never pays off
+		maxPoolDataZize_ = std::clamp<size_t>( maxMemory_ / chunkSize_, 2, ( maxThreadPool_ + readerCount_ ) * 2 );
 		jobDataPool_ = std::make_unique<Concurency::FastCircularQueue<chunk_data_ptr_t>>( maxPoolDataZize_ );
 		freeChunkPool_ = std::make_unique<Concurency::FastCircularQueue<chunk_data_ptr_t>>( maxPoolDataZize_ );
 
@@ -40,7 +153,7 @@ namespace Signature
 
 		while ( freeChunkPool_->count() < maxPoolDataZize_ )
 		{
-			freeChunkPool_->push( std::make_unique<chunk_data_t>( blockSize_ ) );
+			freeChunkPool_->push( std::make_unique<chunk_data_t>( chunkSize_ ) );
 			freeResultPool_->push( std::make_unique<result_data_t>() );
 		}
 
@@ -49,67 +162,338 @@ namespace Signature
 			threadPool_.push_back( std::async( std::launch::async, &MainWorker::hashWorker, this ) );
 		}
 
-		threadPool_.push_back( std::async( std::launch::async, &MainWorker::writeWorker, this ) );
+		newJobs_.resize( readerCount_ );
+		for ( size_t idx = 0; idx < readerCount_; ++idx )
+		{
+			readerPool_.push_back( std::async( std::launch::async, &MainWorker::readWorker, this, idx ) );
+		}
+
+		writerTask_ = std::async( std::launch::async, &MainWorker::writeWorker, this );
 	}
 
 	MainWorker::~MainWorker()
 	{
-		waitThreads();
+		//Not a function-try-block: its handler would see the members destroyed and rethrow
+		try
+		{
+			//Let the queued jobs finish, then join everything
+			waitThreads();
+		}
+		catch ( ... )
+		{
+			//A worker has failed, the others are already interrupted
+			for ( std::future<void>& task : readerPool_ )
+			{
+				if ( task.valid() )
+					task.wait();
+			}
+
+			for ( std::future<void>& task : threadPool_ )
+			{
+				if ( task.valid() )
+					task.wait();
+			}
+
+			if ( writerTask_.valid() )
+				writerTask_.wait();
+		}
+	}
+
+	template <class T>
+	void MainWorker::pushAndNotify( Concurency::FastCircularQueue<T>& queue, T&& element, std::mutex& mutex, std::condition_variable& condition )
+	{
+		//Push under the consumer's mutex so the wakeup can't slip in between its check and its wait
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			queue.push( std::move( element ) );
+		}
+
+		condition.notify_one();
+	}
+
+	void MainWorker::interruptWorkers()
+	{
+		somethingGoesWrong_.store( true, std::memory_order_relaxed );
+
+		std::pair<std::mutex*, std::condition_variable*> waiters[] = {
+			{ &newJobsMutex_, &readerNotBlocked_ },
+			{ &chunkMutex_, &jobPoolNotFull_ },
+			{ &jobMutex_, &jobPoolNotEmpty_ },
+			{ &resultMutex_, &writerPoolNotFull_ },
+			{ &writerMutex_, &writerPoolNotEmpty_ }
+		};
+
+		for ( auto& [mutex, condition] : waiters )
+		{
+			{
+				std::lock_guard<std::mutex> lock( *mutex );
+			}
+
+			condition->notify_all();
+		}
+
+		//Chunks stuck in the queues will never be written, don't keep their owners waiting
+		std::lock_guard<std::mutex> lock( newJobsMutex_ );
+		for ( std::weak_ptr<job_data_t>& weakJob : liveJobs_ )
+		{
+			if ( job_data_ptr_t job = weakJob.lock() )
+			{
+				job->abort( std::make_exception_ptr( std::runtime_error( "signing pipeline is interrupted" ) ) );
+			}
+		}
+
+		liveJobs_.clear();
 	}
 
 	void MainWorker::waitThreads()
 	{
+		//No more jobs will be submitted, the readers leave once every job is read
+		{
+			std::lock_guard<std::mutex> lock( newJobsMutex_ );
+			stopRequested_.store( true, std::memory_order_relaxed );
+		}
+
+		readerNotBlocked_.notify_all();
+
+		for ( std::future<void>& task : readerPool_ )
+		{
+			task.get();
+		}
+
+		readerPool_.clear();
+
+		//Hash workers leave once the job pool is drained
+		{
+			std::lock_guard<std::mutex> lock( jobMutex_ );
+			prepareToExit_.store( true, std::memory_order_relaxed );
+		}
+
+		jobPoolNotEmpty_.notify_all();
+
 		for ( std::future<void>& task : threadPool_ )
 		{
 			task.get();
 		}
 
 		threadPool_.clear();
+
+		//Every result is in the writer pool now, let the writer drain it and leave
+		{
+			std::lock_guard<std::mutex> lock( writerMutex_ );
+			hashingDone_.store( true, std::memory_order_relaxed );
+		}
+
+		writerPoolNotEmpty_.notify_all();
+
+		if ( writerTask_.valid() )
+			writerTask_.get();
+	}
+
+	std::future<void> MainWorker::submit( FileReader&& input, const std::filesystem::path& outFilePath, size_t blockSize )
+	{
+		if ( outFilePath.has_parent_path() && !std::filesystem::exists( outFilePath.parent_path() ) )
+		{
+			throw std::invalid_argument( "output directory doesn't exist" );
+		}
+
+		if ( blockSize < minBlockSize || blockSize > maxBlockSize )
+		{
+			throw std::invalid_argument( "Block size is out of range" );
+		}
+
+		return enqueue( std::make_shared<job_data_t>( std::move( input ), outFilePath, blockSize ) );
+	}
+
+	std::future<void> MainWorker::submit( FileReader&& input, std::ostream& output, size_t blockSize )
+	{
+		if ( blockSize < minBlockSize || blockSize > maxBlockSize )
+		{
+			throw std::invalid_argument( "Block size is out of range" );
+		}
+
+		return enqueue( std::make_shared<job_data_t>( std::move( input ), output, blockSize ) );
+	}
+
+	std::future<void> MainWorker::enqueue( job_data_ptr_t job )
+	{
+		std::future<void> done = job->future();
+
+		{
+			std::lock_guard<std::mutex> lock( newJobsMutex_ );
+			if ( stopRequested_.load( std::memory_order_relaxed ) || somethingGoesWrong_.load( std::memory_order_relaxed ) )
+			{
+				throw std::runtime_error( "signing pipeline is stopped" );
+			}
+
+			liveJobs_.erase( std::remove_if( liveJobs_.begin(), liveJobs_.end(), []( const std::weak_ptr<job_data_t>& weakJob ) { return weakJob.expired(); } ), liveJobs_.end() );
+			liveJobs_.push_back( job );
+
+			//Every reader holds the job until its share is read
+			for ( size_t idx = 1; idx < readerCount_; ++idx )
+			{
+				job->retain();
+			}
+
+			for ( std::deque<job_data_ptr_t>& readerJobs : newJobs_ )
+			{
+				readerJobs.push_back( job );
+			}
+		}
+
+		readerNotBlocked_.notify_all();
+
+		if ( !job->ordered )
+			return done;
+
+		//Deferred, the output is written by whoever waits for the job
+		return std::async( std::launch::deferred, [this, job = std::move( job ), done = std::move( done )]() mutable
+		{
+			drainOrdered( *job );
+			done.get();
+		} );
 	}
 
 	int MainWorker::execute()
+	{
+		//"-" streams the signature to the standard output
+		if ( outFilePath_ == "-" )
+		{
+			submit( FileReader( inFilePath_ ), std::cout, blockSize_ ).get();
+		}
+		else
+		{
+			submit( FileReader( inFilePath_ ), outFilePath_, blockSize_ ).get();
+		}
+
+		//Rethrows the first failure of a worker, if any
+		waitThreads();
+
+		return somethingGoesWrong_.load( std::memory_order_relaxed ) ? 1 : 0;
+	}
+
+	void MainWorker::readWorker( size_t readerIndex )
 	try
 	{
-		FileReader reader( inFilePath_ );
-		size_t blockCount = reader.fileSize() / blockSize_ + ( reader.fileSize() % blockSize_ > 0 );
+		//The reader's share of a job: chunks readerIndex, readerIndex + readerCount_ and so on
+		struct share_t
+		{
+			job_data_ptr_t job;
+			size_t blockIndex = 0;
+		};
 
+		//Jobs being read, served round-robin one chunk per turn
+		std::deque<share_t> activeJobs;
 		chunk_data_ptr_t chunk;
-		for ( size_t blockIdx = 0; blockIdx < blockCount; ++blockIdx )
-		{
-			if ( somethingGoesWrong_.load( std::memory_order_relaxed ) )
-				return 1;
 
+		//As many whole blocks as a chunk holds, a larger block is streamed by the hash worker
+		auto batchSize = [this]( const job_data_t& job ) { return std::max<size_t>( chunkSize_ / job.blockSize, 1 ); };
+		auto isReadable = [this]( const share_t& share ) { return !windowIsFull( *share.job, share.blockIndex ); };
+
+		while ( true )
+		{
 			//Critical section
 			{
-				std::unique_lock<std::mutex> lock( chunkMutex_ );
-				if ( jobDataPool_->isEmpty() )
+				//Sleep while there are no jobs or all of them wait for their output to catch up
+				std::deque<job_data_ptr_t>& newJobs = newJobs_[readerIndex];
+				std::unique_lock<std::mutex> lock( newJobsMutex_ );
+				readerNotBlocked_.wait( lock, [this, &newJobs, &activeJobs, &isReadable]() { return std::any_of( activeJobs.begin(), activeJobs.end(), isReadable ) || !newJobs.empty() || ( activeJobs.empty() && stopRequested_.load( std::memory_order_relaxed ) ) || somethingGoesWrong_.load( std::memory_order_relaxed ); } );
+
+				if ( somethingGoesWrong_.load( std::memory_order_relaxed ) )
+					return;
+
+				for ( job_data_ptr_t& job : newJobs )
 				{
-					while ( !jobPoolNotFull_.wait_for( lock, threadTimeout, [this]() { return !freeChunkPool_->isEmpty(); } ) )
-						continue;
+					const size_t firstBlock = readerIndex * batchSize( *job );
+					activeJobs.push_back( { std::move( job ), firstBlock } );
 				}
 
+				newJobs.clear();
+
+				if ( activeJobs.empty() )
+					return;
+
+				//A new share may start past its window already, sleep again rather than spin
+				if ( std::none_of( activeJobs.begin(), activeJobs.end(), isReadable ) )
+					continue;
+			}
+
+			//Windows only move forward, one of the jobs is still readable by now.
+			//Pass the turn of the jobs held back by their window
+			while ( !isReadable( activeJobs.front() ) )
+			{
+				activeJobs.push_back( std::move( activeJobs.front() ) );
+				activeJobs.pop_front();
+			}
+
+			share_t share = std::move( activeJobs.front() );
+			activeJobs.pop_front();
+
+			job_data_t& job = *share.job;
+			if ( job.failed() || share.blockIndex >= job.blockCount )
+			{
+				job.release();
+				continue;
+			}
+
+			//Critical section
+			{
+				std::unique_lock<std::mutex> lock( chunkMutex_ );
+				jobPoolNotFull_.wait( lock, [this]() { return !freeChunkPool_->isEmpty() || somethingGoesWrong_.load( std::memory_order_relaxed ); } );
+
+				if ( somethingGoesWrong_.load( std::memory_order_relaxed ) )
+					return;
+
 				chunk = freeChunkPool_->pop();
 				assert( chunk );
 			}
 
-			chunk->blockIndex = blockIdx;
-			reader.read( chunk->rawData );
+			const size_t batch = batchSize( job );
+			const size_t blockCount = std::min( batch, job.blockCount - share.blockIndex );
 
-			jobDataPool_->push( std::move( chunk ) );
-		}
+			try
+			{
+				if ( job.blockSize <= chunk->rawData.size() )
+				{
+					const size_t dataSize = blockCount * job.blockSize;
+					const uintmax_t offset = static_cast<uintmax_t>( share.blockIndex ) * job.blockSize;
+					const size_t readSize = job.reader.read( chunk->rawData.data(), dataSize, offset );
 
-		prepareToExit_.store( true, std::memory_order_relaxed );
-		waitThreads();
+					//Pad the short last block, the rest of the chunk isn't hashed
+					std::fill( chunk->rawData.begin() + readSize, chunk->rawData.begin() + dataSize, 0 );
+				}
+			}
+			catch ( ... )
+			{
+				job.fail( std::current_exception() );
+				job.release();
 
-		return 0;
+				pushAndNotify( *freeChunkPool_, std::move( chunk ), chunkMutex_, jobPoolNotFull_ );
+				continue;
+			}
+
+			chunk->job = share.job;
+			chunk->blockIndex = share.blockIndex;
+			chunk->blockCount = blockCount;
+			share.blockIndex += batch * readerCount_;
+
+			//The last chunk of the share takes over the reader's reference
+			if ( share.blockIndex < job.blockCount )
+			{
+				job.retain();
+				activeJobs.push_back( std::move( share ) );
+			}
+
+			pushAndNotify( *jobDataPool_, std::move( chunk ), jobMutex_, jobPoolNotEmpty_ );
+		}
 	}
 	catch ( ... )
 	{
-		somethingGoesWrong_.store( true, std::memory_order_relaxed );
+		interruptWorkers();
 		throw;
 	}
 
-	void MainWorker::hashWorker() try
+	void MainWorker::hashWorker()
+	try
 	{
 		chunk_data_ptr_t chunk;
 		result_data_ptr_t result;
@@ -119,76 +503,219 @@ namespace Signature
 			//Critical section
 			{
 				std::unique_lock<std::mutex> lock( jobMutex_ );
-				if ( jobDataPool_->isEmpty() )
-				{
-					while ( !jobPoolNotEmpty_.wait_for( lock, threadTimeout, [this]() { return !jobDataPool_->isEmpty() || prepareToExit_.load( std::memory_order_relaxed ) || somethingGoesWrong_.load( std::memory_order_relaxed ); } ) )
-						continue;
+				jobPoolNotEmpty_.wait( lock, [this]() { return !jobDataPool_->isEmpty() || prepareToExit_.load( std::memory_order_relaxed ) || somethingGoesWrong_.load( std::memory_order_relaxed ); } );
 
-                    if ( (jobDataPool_->isEmpty() && prepareToExit_.load( std::memory_order_relaxed )) || somethingGoesWrong_.load( std::memory_order_relaxed ) )
-						return;
-				}
+				if ( jobDataPool_->isEmpty() || somethingGoesWrong_.load( std::memory_order_relaxed ) )
+					return;
 
 				chunk = jobDataPool_->pop();
 				assert( chunk );
+			}
+
+			//Critical section
+			{
+				std::unique_lock<std::mutex> lock( resultMutex_ );
+				writerPoolNotFull_.wait( lock, [this]() { return !freeResultPool_->isEmpty() || somethingGoesWrong_.load( std::memory_order_relaxed ); } );
+
+				if ( somethingGoesWrong_.load( std::memory_order_relaxed ) )
+					return;
 
 				result = freeResultPool_->pop();
 				assert( result );
 			}
 
+			job_data_t& job = *chunk->job;
 			result->blockIndex = chunk->blockIndex;
-			result->hashSum = Security::CRC32::calculate( chunk->rawData );
-			writerPool_->push( std::move( result ) );
+			result->hashSums.resize( chunk->blockCount );
+
+			if ( job.blockSize > chunk->rawData.size() )
+			{
+				try
+				{
+					result->hashSums.front() = streamBlock( job, *chunk );
+				}
+				catch ( ... )
+				{
+					job.fail( std::current_exception() );
+				}
+			}
+			else
+			{
+				Security::CRC32::calculate( chunk->rawData.data(), job.blockSize, chunk->blockCount, result->hashSums.data() );
+			}
+
+			result->job = std::move( chunk->job );
+			pushAndNotify( *writerPool_, std::move( result ), writerMutex_, writerPoolNotEmpty_ );
 
-			//Clear data in chunk
-			std::fill( chunk->rawData.begin(), chunk->rawData.end(), 0 );
 			chunk->blockIndex = 0;
+			chunk->blockCount = 0;
 
 			//retrun to free chunk pool
-			freeChunkPool_->push( std::move( chunk ) );
+			pushAndNotify( *freeChunkPool_, std::move( chunk ), chunkMutex_, jobPoolNotFull_ );
 		}
 	}
 	catch ( ... )
 	{
-		somethingGoesWrong_.store( true, std::memory_order_relaxed );
+		interruptWorkers();
 		throw;
 	}
 
+	uint32_t MainWorker::streamBlock( job_data_t& job, chunk_data_t& chunk )
+	{
+		const uintmax_t blockOffset = static_cast<uintmax_t>( chunk.blockIndex ) * job.blockSize;
+		uint32_t crc = Security::CRC32::initial;
+
+		for ( size_t offset = 0; offset < job.blockSize && !job.failed(); offset += chunk.rawData.size() )
+		{
+			const size_t length = std::min( chunk.rawData.size(), job.blockSize - offset );
+			const size_t readSize = job.reader.read( chunk.rawData.data(), length, blockOffset + offset );
+
+			//Past the end of file the last block is padded with zeros
+			std::fill( chunk.rawData.begin() + readSize, chunk.rawData.begin() + length, 0 );
+			crc = Security::CRC32::update( crc, chunk.rawData.data(), length );
+		}
+
+		return Security::CRC32::finalize( crc );
+	}
+
+	bool MainWorker::windowIsFull( const job_data_t& job, size_t blockIndex ) const
+	{
+		if ( !job.ordered || job.failed() || blockIndex >= job.blockCount )
+			return false;
+
+		//As many chunks ahead of the output as the pool holds
+		const size_t windowSize = maxPoolDataZize_ * std::max<size_t>( chunkSize_ / job.blockSize, 1 );
+		return blockIndex >= job.writtenCount.load( std::memory_order_acquire ) + windowSize;
+	}
+
+	void MainWorker::writeOrdered( job_data_t& job, result_data_t& data )
+	{
+		if ( data.blockIndex != job.handedCount )
+		{
+			job.reorderBuffer.emplace( data.blockIndex, std::move( data.hashSums ) );
+			return;
+		}
+
+		//Critical section
+		{
+			std::lock_guard<std::mutex> lock( job.readyMutex );
+			job.handedCount += data.hashSums.size();
+			job.readyHashSums.push_back( std::move( data.hashSums ) );
+
+			//Hand over whatever has become contiguous
+			auto it = job.reorderBuffer.begin();
+			for ( ; it != job.reorderBuffer.end() && it->first == job.handedCount; it = job.reorderBuffer.erase( it ) )
+			{
+				job.handedCount += it->second.size();
+				job.readyHashSums.push_back( std::move( it->second ) );
+			}
+		}
+
+		job.readyChanged.notify_one();
+	}
+
+	void MainWorker::drainOrdered( job_data_t& job )
+	{
+		std::vector<uint32_t> hashSums;
+
+		while ( true )
+		{
+			//Critical section
+			{
+				std::unique_lock<std::mutex> lock( job.readyMutex );
+				job.readyChanged.wait( lock, [&job]() { return !job.readyHashSums.empty() || job.handedOver || job.failed(); } );
+
+				if ( job.failed() || job.readyHashSums.empty() )
+					break;
+
+				hashSums = std::move( job.readyHashSums.front() );
+				job.readyHashSums.pop_front();
+			}
+
+			try
+			{
+				job.writer.append( hashSums );
+			}
+			catch ( ... )
+			{
+				job.fail( std::current_exception() );
+			}
+
+			job.writtenCount.fetch_add( hashSums.size(), std::memory_order_release );
+
+			//The window of the job has moved on, or the job has failed and has to be let go
+			{
+				std::lock_guard<std::mutex> lock( newJobsMutex_ );
+			}
+
+			readerNotBlocked_.notify_all();
+		}
+
+		job.complete();
+	}
+
 	void MainWorker::writeWorker()
 	try
 	{
-		FileWriter writer( outFilePath_ );
 		result_data_ptr_t data;
 
 		while ( true )
 		{
 			{
 				std::unique_lock<std::mutex> lock( writerMutex_ );
-				if ( writerPool_->isEmpty() )
-				{
-					while ( !writerPoolNotEmpty_.wait_for( lock, std::chrono::milliseconds( 100 ), [this]() { return !writerPool_->isEmpty() || prepareToExit_.load( std::memory_order_relaxed ) || somethingGoesWrong_.load( std::memory_order_relaxed ); } ) )
-						continue;
+				writerPoolNotEmpty_.wait( lock, [this]() { return !writerPool_->isEmpty() || hashingDone_.load( std::memory_order_relaxed ) || somethingGoesWrong_.load( std::memory_order_relaxed ); } );
 
-                    if ( (writerPool_->isEmpty() && prepareToExit_.load( std::memory_order_relaxed )) || somethingGoesWrong_.load( std::memory_order_relaxed ) )
-						return;
-				}
+				if ( writerPool_->isEmpty() || somethingGoesWrong_.load( std::memory_order_relaxed ) )
+					return;
 
 				data = writerPool_->pop();
 				assert( data );
 			}
 
-			writer.write( *data );
+			job_data_ptr_t job = std::move( data->job );
+
+			if ( !job->failed() )
+			{
+				try
+				{
+					if ( job->ordered )
+					{
+						writeOrdered( *job, *data );
+					}
+					else
+					{
+						job->writer.write( *data );
+					}
+				}
+				catch ( ... )
+				{
+					job->fail( std::current_exception() );
+				}
+			}
+
+			//A failed job no longer waits for its window
+			if ( job->ordered && job->failed() )
+			{
+				{
+					std::lock_guard<std::mutex> lock( newJobsMutex_ );
+				}
+
+				readerNotBlocked_.notify_all();
+			}
+
+			job->release();
 
 			//clear data
 			data->blockIndex = 0;
-			data->hashSum = 0;
+			data->hashSums.clear();
 
 			//return to pool
-			freeResultPool_->push( std::move( data ) );
+			pushAndNotify( *freeResultPool_, std::move( data ), resultMutex_, writerPoolNotFull_ );
 		}
 	}
 	catch ( ... )
 	{
-		somethingGoesWrong_.store( true, std::memory_order_relaxed );
+		interruptWorkers();
 		throw;
 	}
 } // namespace Signature
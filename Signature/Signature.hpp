@@ -2,54 +2,187 @@
 
 #include "types.hpp"
 #include "Queue.hpp"
+#include "FileReader.hpp"
+#include "FileWriter.hpp"
 
-#include <chrono>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <atomic>
 #include <future>
 #include <filesystem>
 #include <condition_variable>
 
 namespace Signature
 {
+	/**
+	 * One signing request travelling through the shared pipeline. Every chunk and result
+	 * holds a reference to its job, the job completes when the last of them is written.
+	*/
+	struct job_data_t
+	{
+		FileReader reader;
+		FileWriter writer;
+
+		const size_t blockSize = 0;
+		size_t blockCount = 0;
+
+		//Output that can't seek gets the results in order: the writer thread parks early ones
+		//here and hands the contiguous ones over to the thread waiting on the job, which does
+		//the blocking writes. The readers stay within a window past the last block written.
+		const bool ordered = false;
+		std::map<size_t, std::vector<uint32_t>> reorderBuffer;
+		size_t handedCount = 0; // touched by the writer thread only
+		std::atomic_size_t writtenCount = 0;
+
+		std::mutex readyMutex;
+		std::condition_variable readyChanged;
+		std::deque<std::vector<uint32_t>> readyHashSums;
+		bool handedOver = false;
+
+		job_data_t( FileReader&& input, const std::filesystem::path& outFilePath, size_t blockSize );
+		job_data_t( FileReader&& input, std::ostream& output, size_t blockSize );
+
+		/**
+		 * Records the first error of the job, the remaining blocks are skipped.
+		*/
+		void fail( std::exception_ptr error );
+
+		/**
+		 * Adds a pending reference for one more chunk in flight.
+		*/
+		void retain();
+
+		/**
+		 * Drops one pending reference and completes the job if it was the last one. An ordered
+		 * job is completed by its drain once the last result is written.
+		*/
+		void release();
+
+		/**
+		 * Closes the output and makes the future ready.
+		*/
+		void complete();
+
+		/**
+		 * Completes the job right away, used when the pipeline is interrupted.
+		*/
+		void abort( std::exception_ptr error );
+
+		bool failed() const { return failed_.load( std::memory_order_relaxed ); }
+		std::future<void> future() { return done_.get_future(); }
+
+	private:
+		//Chunks in flight plus one reference per reader held until its share of blocks is read
+		std::atomic_size_t pendingCount_ = 1;
+		std::atomic_bool failed_ = false;
+		std::atomic_bool finished_ = false;
+
+		std::mutex errorMutex_;
+		std::exception_ptr error_;
+		std::promise<void> done_;
+
+		void finish();
+	};
+
 	class MainWorker
 	{
 	public:
-		MainWorker( const std::filesystem::path& inFilePath, const std::filesystem::path& outFilePath, size_t blockSize );
+		/**
+		 * Starts a long-living pipeline whose buffers fit into maxMemory bytes. Blocks larger
+		 * than a chunk are hashed in chunk-sized pieces, so any block size is accepted.
+		 * Every job is read by readerCount threads, each owning every readerCount-th chunk.
+		*/
+		explicit MainWorker( size_t maxMemory, size_t readerCount = 1 );
+		MainWorker( const std::filesystem::path& inFilePath, const std::filesystem::path& outFilePath, size_t blockSize, size_t maxMemory, size_t readerCount = 1 );
 		~MainWorker();
 
 		int execute();
 
+		/**
+		 * Queues a signing job, jobs are read in turns one chunk at a time so that a large
+		 * file doesn't starve the others. The future is ready once the output is closed.
+		*/
+		std::future<void> submit( FileReader&& input, const std::filesystem::path& outFilePath, size_t blockSize );
+
+		/**
+		 * Same as above but the signature is streamed in order to a caller's output, which
+		 * has to outlive the job. Reading is held back while the output lags behind.
+		 *
+		 * Ordered output is written by the thread calling get() on the returned future, so a
+		 * slow consumer only stalls its own job and the output is never touched afterwards.
+		*/
+		std::future<void> submit( FileReader&& input, std::ostream& output, size_t blockSize );
+
+		/**
+		 * True once a worker has failed, the pipeline takes no more jobs after that.
+		*/
+		bool interrupted() const { return somethingGoesWrong_.load( std::memory_order_relaxed ); }
+
+		static constexpr size_t minBlockSize = 1024; // 1 Kb
+		static constexpr size_t maxBlockSize = 64 * 1048576; // 64 Mb
+
 	private:
         const std::filesystem::path inFilePath_;
         const std::filesystem::path outFilePath_;
 
         const size_t blockSize_ = 0;
-		
+		size_t chunkSize_ = 0;
+		const size_t maxMemory_ = 0;
+		const size_t readerCount_ = 0;
+
 		size_t maxThreadPool_ = 0;
 		size_t maxPoolDataZize_ = 0;
-        
+
 		std::vector<std::future<void>> threadPool_;
+		std::vector<std::future<void>> readerPool_;
+		std::future<void> writerTask_;
         std::unique_ptr<Concurency::FastCircularQueue<chunk_data_ptr_t>> jobDataPool_ = nullptr;
 		std::unique_ptr<Concurency::FastCircularQueue<chunk_data_ptr_t>> freeChunkPool_ = nullptr;
 
 		std::unique_ptr<Concurency::FastCircularQueue<result_data_ptr_t>> writerPool_ = nullptr;
         std::unique_ptr<Concurency::FastCircularQueue<result_data_ptr_t>> freeResultPool_ = nullptr;
 
+		//Submitted jobs not yet picked up, one queue per reader, and every job not yet completed
+		std::vector<std::deque<job_data_ptr_t>> newJobs_;
+		std::vector<std::weak_ptr<job_data_t>> liveJobs_;
+
 		static constexpr uint8_t defaultThreadCount = 4;
-		static constexpr std::chrono::milliseconds threadTimeout{ 100 };
+		static constexpr size_t maxChunkSize = 4 * 1048576; // 4 Mb
+		static constexpr size_t minBatchSize = 1048576; // 1 Mb, small blocks are read and hashed in batches of at least this size
 
+		// Every queue has a mutex/condition pair; producers push under the mutex and notify,
+		// so consumers sleep until there is work instead of polling.
+		std::condition_variable readerNotBlocked_;
 		std::condition_variable writerPoolNotEmpty_;
+		std::condition_variable writerPoolNotFull_;
 		std::condition_variable jobPoolNotEmpty_;
 		std::condition_variable jobPoolNotFull_;
 
+		std::mutex newJobsMutex_;
 		std::mutex writerMutex_;
+		std::mutex resultMutex_;
 		std::mutex chunkMutex_;
 		std::mutex jobMutex_;
 
+		std::atomic_bool stopRequested_ = false;
 		std::atomic_bool prepareToExit_ = false;
+		std::atomic_bool hashingDone_ = false;
 		std::atomic_bool somethingGoesWrong_ = false;
 
+		void startWorkers();
+		void readWorker( size_t readerIndex );
 		void hashWorker();
 		void writeWorker();
 		void waitThreads();
+		std::future<void> enqueue( job_data_ptr_t job );
+		bool windowIsFull( const job_data_t& job, size_t blockIndex ) const;
+		void writeOrdered( job_data_t& job, result_data_t& data );
+		void drainOrdered( job_data_t& job );
+		uint32_t streamBlock( job_data_t& job, chunk_data_t& chunk );
+		void interruptWorkers();
+
+		template <class T>
+		static void pushAndNotify( Concurency::FastCircularQueue<T>& queue, T&& element, std::mutex& mutex, std::condition_variable& condition );
 	};
 } // namespace Signature
@@ -0,0 +1,369 @@
+#include "Socket.hpp"
+
+#if !defined( _WIN32 )
+
+#include <chrono>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include <system_error>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+
+namespace Signature
+{
+	namespace Service
+	{
+		namespace
+		{
+			static constexpr char messageEnd[] = "\n\n";
+			static constexpr size_t maxMessageSize = 64 * 1024;
+
+			sockaddr_un makeAddress( const std::filesystem::path& socketPath )
+			{
+				sockaddr_un address = {};
+				address.sun_family = AF_UNIX;
+
+				const std::string& path = socketPath.native();
+				if ( path.size() >= sizeof( address.sun_path ) )
+				{
+					throw std::invalid_argument( "socket path is too long" );
+				}
+
+				std::memcpy( address.sun_path, path.c_str(), path.size() + 1 );
+				return address;
+			}
+
+			[[noreturn]] void throwSystemError( const char* what )
+			{
+				throw std::system_error( errno, std::generic_category(), what );
+			}
+
+			//A socket file left behind by a daemon that didn't exit cleanly refuses connections,
+			//only such a file is removed, a live socket or any other file stays where it is
+			void removeStaleSocket( const std::filesystem::path& socketPath, const sockaddr_un& address )
+			{
+				struct stat status = {};
+				if ( ::lstat( socketPath.c_str(), &status ) < 0 )
+				{
+					if ( errno == ENOENT )
+						return;
+
+					throwSystemError( "lstat" );
+				}
+
+				if ( !S_ISSOCK( status.st_mode ) )
+				{
+					throw std::system_error( EADDRINUSE, std::generic_category(), "bind" );
+				}
+
+				UnixSocket probe( ::socket( AF_UNIX, SOCK_STREAM, 0 ) );
+				if ( probe.descriptor() < 0 )
+					throwSystemError( "socket" );
+
+				if ( !::connect( probe.descriptor(), reinterpret_cast<const sockaddr*>( &address ), sizeof( address ) ) )
+				{
+					throw std::system_error( EADDRINUSE, std::generic_category(), "bind" );
+				}
+
+				if ( errno != ECONNREFUSED )
+					throwSystemError( "connect" );
+
+				if ( ::unlink( socketPath.c_str() ) < 0 && errno != ENOENT )
+					throwSystemError( "unlink" );
+			}
+		} // namespace
+
+		UnixSocket::UnixSocket( int descriptor ) :
+			descriptor_( descriptor )
+		{
+		}
+
+		UnixSocket::UnixSocket( UnixSocket&& other ) noexcept :
+			descriptor_( other.descriptor_ ), pending_( std::move( other.pending_ ) )
+		{
+			other.descriptor_ = -1;
+		}
+
+		UnixSocket& UnixSocket::operator=( UnixSocket&& other ) noexcept
+		{
+			if ( this != &other )
+			{
+				close();
+				descriptor_ = other.descriptor_;
+				pending_ = std::move( other.pending_ );
+				other.descriptor_ = -1;
+			}
+
+			return *this;
+		}
+
+		UnixSocket::~UnixSocket()
+		{
+			close();
+		}
+
+		UnixSocket UnixSocket::listen( const std::filesystem::path& socketPath, std::filesystem::perms permissions )
+		{
+			sockaddr_un address = makeAddress( socketPath );
+			UnixSocket listener( ::socket( AF_UNIX, SOCK_STREAM, 0 ) );
+
+			if ( listener.descriptor_ < 0 )
+				throwSystemError( "socket" );
+
+			removeStaleSocket( socketPath, address );
+
+			if ( ::bind( listener.descriptor_, reinterpret_cast<const sockaddr*>( &address ), sizeof( address ) ) < 0 )
+				throwSystemError( "bind" );
+
+			//Connections are refused until listen(), the umask's mode is never exposed
+			if ( ::chmod( socketPath.c_str(), static_cast<mode_t>( permissions ) ) < 0 )
+				throwSystemError( "chmod" );
+
+			if ( ::listen( listener.descriptor_, SOMAXCONN ) < 0 )
+				throwSystemError( "listen" );
+
+			return listener;
+		}
+
+		UnixSocket UnixSocket::connect( const std::filesystem::path& socketPath )
+		{
+			sockaddr_un address = makeAddress( socketPath );
+			UnixSocket connection( ::socket( AF_UNIX, SOCK_STREAM, 0 ) );
+
+			if ( connection.descriptor_ < 0 )
+				throwSystemError( "socket" );
+
+			if ( ::connect( connection.descriptor_, reinterpret_cast<const sockaddr*>( &address ), sizeof( address ) ) < 0 )
+				throwSystemError( "connect" );
+
+			return connection;
+		}
+
+		UnixSocket UnixSocket::accept()
+		{
+			int descriptor = -1;
+			do
+			{
+				descriptor = ::accept( descriptor_, nullptr, nullptr );
+			} while ( descriptor < 0 && errno == EINTR );
+
+			if ( descriptor < 0 )
+				throwSystemError( "accept" );
+
+			return UnixSocket( descriptor );
+		}
+
+		void UnixSocket::send( const std::string& message, const std::vector<int>& passedDescriptors )
+		{
+			if ( passedDescriptors.size() > maxPassedDescriptors )
+			{
+				throw std::invalid_argument( "too many descriptors to pass" );
+			}
+
+			std::string data = message + messageEnd;
+			size_t offset = 0;
+
+			while ( offset < data.size() )
+			{
+				iovec buffer = { data.data() + offset, data.size() - offset };
+
+				msghdr header = {};
+				header.msg_iov = &buffer;
+				header.msg_iovlen = 1;
+
+				//The descriptors ride along with the first byte of the message
+				alignas( cmsghdr ) char control[CMSG_SPACE( sizeof( int ) * maxPassedDescriptors )] = {};
+				if ( !passedDescriptors.empty() && offset == 0 )
+				{
+					const size_t dataSize = sizeof( int ) * passedDescriptors.size();
+
+					header.msg_control = control;
+					header.msg_controllen = CMSG_SPACE( dataSize );
+
+					cmsghdr* controlHeader = CMSG_FIRSTHDR( &header );
+					controlHeader->cmsg_level = SOL_SOCKET;
+					controlHeader->cmsg_type = SCM_RIGHTS;
+					controlHeader->cmsg_len = CMSG_LEN( dataSize );
+					std::memcpy( CMSG_DATA( controlHeader ), passedDescriptors.data(), dataSize );
+				}
+
+				ssize_t sent = ::sendmsg( descriptor_, &header, 0 );
+				if ( sent < 0 )
+				{
+					if ( errno == EINTR )
+						continue;
+
+					throwSystemError( "sendmsg" );
+				}
+
+				offset += static_cast<size_t>( sent );
+			}
+		}
+
+		std::string UnixSocket::receive( std::vector<int>* passedDescriptors, int stopDescriptor, int timeout )
+		{
+			if ( passedDescriptors )
+				passedDescriptors->clear();
+
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( std::max( timeout, 0 ) );
+
+			size_t end = pending_.find( messageEnd );
+			while ( end == std::string::npos )
+			{
+				if ( pending_.size() > maxMessageSize )
+				{
+					throw std::runtime_error( "message is too long" );
+				}
+
+				//The whole message has to arrive in time, not each piece of it
+				int remaining = -1;
+				if ( timeout >= 0 )
+				{
+					auto left = std::chrono::duration_cast<std::chrono::milliseconds>( deadline - std::chrono::steady_clock::now() );
+					remaining = static_cast<int>( std::max<std::chrono::milliseconds::rep>( left.count(), 0 ) );
+				}
+
+				//poll() skips a negative descriptor
+				pollfd descriptors[] = {
+					{ descriptor_, POLLIN, 0 },
+					{ stopDescriptor, POLLIN, 0 }
+				};
+
+				int ready = ::poll( descriptors, 2, remaining );
+				if ( ready < 0 )
+				{
+					if ( errno == EINTR )
+						continue;
+
+					throwSystemError( "poll" );
+				}
+
+				if ( !ready )
+				{
+					throw std::runtime_error( "timed out waiting for a message" );
+				}
+
+				if ( descriptors[1].revents )
+				{
+					throw std::runtime_error( "interrupted while waiting for a message" );
+				}
+
+				char data[4096];
+				iovec buffer = { data, sizeof( data ) };
+
+				alignas( cmsghdr ) char control[CMSG_SPACE( sizeof( int ) * maxPassedDescriptors )] = {};
+				msghdr header = {};
+				header.msg_iov = &buffer;
+				header.msg_iovlen = 1;
+				header.msg_control = control;
+				header.msg_controllen = sizeof( control );
+
+				ssize_t received = ::recvmsg( descriptor_, &header, 0 );
+				if ( received < 0 )
+				{
+					if ( errno == EINTR )
+						continue;
+
+					throwSystemError( "recvmsg" );
+				}
+
+				for ( cmsghdr* controlHeader = CMSG_FIRSTHDR( &header ); controlHeader; controlHeader = CMSG_NXTHDR( &header, controlHeader ) )
+				{
+					if ( controlHeader->cmsg_level == SOL_SOCKET && controlHeader->cmsg_type == SCM_RIGHTS )
+					{
+						const size_t count = ( controlHeader->cmsg_len - CMSG_LEN( 0 ) ) / sizeof( int );
+						for ( size_t idx = 0; idx < count; ++idx )
+						{
+							int descriptor = -1;
+							std::memcpy( &descriptor, CMSG_DATA( controlHeader ) + idx * sizeof( int ), sizeof( int ) );
+
+							//Nobody asked for it, don't leak it
+							if ( passedDescriptors )
+								passedDescriptors->push_back( descriptor );
+							else
+								::close( descriptor );
+						}
+					}
+				}
+
+				if ( !received )
+				{
+					throw std::runtime_error( "connection closed" );
+				}
+
+				pending_.append( data, static_cast<size_t>( received ) );
+				end = pending_.find( messageEnd );
+			}
+
+			std::string message = pending_.substr( 0, end );
+			pending_.erase( 0, end + sizeof( messageEnd ) - 1 );
+
+			return message;
+		}
+
+		void UnixSocket::close()
+		{
+			if ( descriptor_ >= 0 )
+			{
+				::close( descriptor_ );
+				descriptor_ = -1;
+			}
+		}
+
+		std::streamsize DescriptorOutput::xsputn( const char* data, std::streamsize size )
+		{
+			std::streamsize offset = 0;
+			while ( offset < size )
+			{
+				pollfd descriptors[] = {
+					{ descriptor_, POLLOUT, 0 },
+					{ stopDescriptor_, POLLIN, 0 }
+				};
+
+				if ( ::poll( descriptors, 2, -1 ) < 0 )
+				{
+					if ( errno == EINTR )
+						continue;
+
+					break;
+				}
+
+				if ( descriptors[1].revents )
+					break;
+
+				//Room for PIPE_BUF bytes is what POLLOUT promises, a larger write may block again
+				const size_t length = std::min<size_t>( static_cast<size_t>( size - offset ), PIPE_BUF );
+				ssize_t written = ::write( descriptor_, data + offset, length );
+				if ( written < 0 )
+				{
+					if ( errno == EINTR )
+						continue;
+
+					//The stream turns it into badbit
+					break;
+				}
+
+				offset += written;
+			}
+
+			return offset;
+		}
+
+		DescriptorOutput::int_type DescriptorOutput::overflow( int_type character )
+		{
+			if ( traits_type::eq_int_type( character, traits_type::eof() ) )
+				return traits_type::not_eof( character );
+
+			char data = traits_type::to_char_type( character );
+			return xsputn( &data, 1 ) == 1 ? character : traits_type::eof();
+		}
+	} // namespace Service
+} // namespace Signature
+
+#endif // !_WIN32
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <streambuf>
+#include <filesystem>
+
+namespace Signature
+{
+	namespace Service
+	{
+		/**
+		 * Owning wrapper over a Unix domain stream socket. A message is a text block ending
+		 * with an empty line, open file descriptors may be passed along with it.
+		*/
+		class UnixSocket final
+		{
+		public:
+			UnixSocket() = default;
+			explicit UnixSocket( int descriptor );
+			UnixSocket( UnixSocket&& other ) noexcept;
+			UnixSocket& operator=( UnixSocket&& other ) noexcept;
+			~UnixSocket();
+
+			/**
+			 * Creates the socket file with the given permissions, by default only the daemon's own
+			 * user may connect. Whoever connects can make the daemon read and write files on its behalf.
+			*/
+			static UnixSocket listen( const std::filesystem::path& socketPath, std::filesystem::perms permissions = std::filesystem::perms::owner_read | std::filesystem::perms::owner_write );
+			static UnixSocket connect( const std::filesystem::path& socketPath );
+
+			UnixSocket accept();
+
+			static constexpr size_t maxPassedDescriptors = 4;
+
+			void send( const std::string& message, const std::vector<int>& passedDescriptors = {} );
+
+			/**
+			 * Waits for a whole message. It gives up once stopDescriptor becomes readable or after
+			 * timeout milliseconds, a negative descriptor or timeout waits forever as poll() does.
+			*/
+			std::string receive( std::vector<int>* passedDescriptors = nullptr, int stopDescriptor = -1, int timeout = -1 );
+
+			int descriptor() const { return descriptor_; }
+			void close();
+
+		private:
+			int descriptor_ = -1;
+
+			//Bytes received past the end of the last message
+			std::string pending_;
+
+			UnixSocket( const UnixSocket& ) = delete;
+			UnixSocket& operator=( const UnixSocket& ) = delete;
+		};
+
+		/**
+		 * Unbuffered stream buffer writing straight into a descriptor the caller owns, lets
+		 * a std::ostream target a pipe, a terminal or a socket handed over by a client. A write
+		 * stalled by a slow reader gives up once stopDescriptor becomes readable.
+		*/
+		class DescriptorOutput final : public std::streambuf
+		{
+		public:
+			explicit DescriptorOutput( int descriptor, int stopDescriptor = -1 ) :
+				descriptor_( descriptor ), stopDescriptor_( stopDescriptor ) {}
+
+		protected:
+			std::streamsize xsputn( const char* data, std::streamsize size ) override;
+			int_type overflow( int_type character ) override;
+
+		private:
+			const int descriptor_;
+			const int stopDescriptor_;
+		};
+	} // namespace Service
+} // namespace Signature
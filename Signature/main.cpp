@@ -1,69 +1,292 @@
 #include "Signature.hpp"
+#include "Daemon.hpp"
+#include "Client.hpp"
 
+#include <cerrno>
+#include <chrono>
+#include <limits>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
 #include <iostream>
 
+#if defined( _WIN32 )
+#include <io.h>
+#include <fcntl.h>
+#endif // _WIN32
+
 namespace
 {
 	static constexpr uint64_t inMegabytes = 1048576;
 	static constexpr uint64_t DefaultBlockSize = inMegabytes; // 1 Mb
-} // namespace
+	static constexpr uint64_t DefaultMaxMemory = 256 * inMegabytes; // 256 Mb
+	static constexpr size_t DefaultReaderCount = 1;
 
-int main( int argc, char* argv[] )
-{
-	if ( argc < 3 || argc == 4 || argc > 5 )
+	enum class Mode
 	{
-		std::cout << "Usage: <app-name> <input-file-path> <output-file-path> [-bs <block size, 1MB by default>]" << std::endl
-				  << "\t- enter block size as a decimal number of bytes, 1024B min, 64MB max" << std::endl;
+		Local,
+		Daemon,
+		Client
+	};
 
-		return 0;
+	//Diagnostics move to stderr while the signature is streamed to stdout
+	std::ostream* console = &std::cout;
+
+	struct options_t
+	{
+		Mode mode = Mode::Local;
+		std::vector<const char*> paths;
+		size_t blockSize = DefaultBlockSize;
+		size_t maxMemory = DefaultMaxMemory;
+		size_t readerCount = DefaultReaderCount;
+		bool passDescriptor = false;
+	};
+
+	void printUsage()
+	{
+		std::cout << "Usage: <app-name> <input-file-path> <output-file-path> [-bs <block size, 1MB by default>] [-max-memory <buffer budget, 256MB by default>] [-readers <reader count, 1 by default>]" << std::endl
+				  << "       <app-name> -daemon <socket-path> [-max-memory <buffer budget, 256MB by default>] [-readers <reader count, 1 by default>]" << std::endl
+				  << "       <app-name> -client <socket-path> <input-file-path> <output-file-path> [-bs <block size, 1MB by default>] [-fd]" << std::endl
+				  << "\t- enter block size as a decimal number of bytes, 1024B min, 64MB max" << std::endl
+				  << "\t- enter buffer budget as a decimal number of megabytes, blocks larger than a buffer chunk (4MB, or half of a smaller budget) are hashed in chunk-sized pieces to stay within it" << std::endl
+				  << "\t- readers split the input file between them and read it in parallel, 64 max" << std::endl
+				  << "\t- -fd hands the opened input file over to the daemon instead of its path" << std::endl
+				  << "\t- an output file path of - streams the signature to stdout in block order" << std::endl;
 	}
 
-	size_t blockSize = DefaultBlockSize;
+	//A decimal number and nothing else, std::atol would take "-1" or "12abc" as well
+	bool parseNumber( const char* value, size_t& number )
+	{
+		if ( !*value || std::strspn( value, "0123456789" ) != std::strlen( value ) )
+			return false;
+
+		errno = 0;
+		unsigned long long parsed = std::strtoull( value, nullptr, 10 );
+		if ( errno == ERANGE || parsed > std::numeric_limits<size_t>::max() )
+			return false;
+
+		number = static_cast<size_t>( parsed );
+		return true;
+	}
 
-	if ( argc > 3 )
+	bool parseOptions( int argc, char* argv[], options_t& options )
 	{
-		if ( std::strcmp( argv[3], "-bs" ) )
+		int idx = 1;
+		if ( !std::strcmp( argv[idx], "-daemon" ) )
 		{
-			std::cout << "Error: Wrong argument, launch app with no arguments for help" << std::endl;
-
-			return 1;
+			options.mode = Mode::Daemon;
+			++idx;
+		}
+		else if ( !std::strcmp( argv[idx], "-client" ) )
+		{
+			options.mode = Mode::Client;
+			++idx;
 		}
 
-		blockSize = std::atol( argv[4] );
+		for ( ; idx < argc; ++idx )
+		{
+			if ( !std::strcmp( argv[idx], "-bs" ) && idx + 1 < argc && options.mode != Mode::Daemon )
+			{
+				if ( !parseNumber( argv[++idx], options.blockSize ) )
+				{
+					std::cout << "Error: Wrong block size format, launch app with no arguments for help" << std::endl;
+
+					return false;
+				}
+
+				if ( options.blockSize > Signature::MainWorker::maxBlockSize || options.blockSize < Signature::MainWorker::minBlockSize )
+				{
+					std::cout << "Error: Wrong block size, launch app with no arguments for help" << std::endl;
+
+					return false;
+				}
+			}
+			else if ( !std::strcmp( argv[idx], "-max-memory" ) && idx + 1 < argc && options.mode != Mode::Client )
+			{
+				size_t megabytes = 0;
+				if ( !parseNumber( argv[++idx], megabytes ) )
+				{
+					std::cout << "Error: Wrong buffer budget format, launch app with no arguments for help" << std::endl;
 
-		if ( !blockSize )
+					return false;
+				}
+
+				if ( !megabytes || megabytes > std::numeric_limits<size_t>::max() / inMegabytes )
+				{
+					std::cout << "Error: Wrong buffer budget, launch app with no arguments for help" << std::endl;
+
+					return false;
+				}
+
+				options.maxMemory = megabytes * inMegabytes;
+			}
+			else if ( !std::strcmp( argv[idx], "-readers" ) && idx + 1 < argc && options.mode != Mode::Client )
+			{
+				if ( !parseNumber( argv[++idx], options.readerCount ) )
+				{
+					std::cout << "Error: Wrong reader count format, launch app with no arguments for help" << std::endl;
+
+					return false;
+				}
+
+				if ( !options.readerCount || options.readerCount > 64 )
+				{
+					std::cout << "Error: Wrong reader count, launch app with no arguments for help" << std::endl;
+
+					return false;
+				}
+			}
+			else if ( !std::strcmp( argv[idx], "-fd" ) && options.mode == Mode::Client )
+			{
+				options.passDescriptor = true;
+			}
+			else if ( argv[idx][0] == '-' && argv[idx][1] )
+			{
+				std::cout << "Error: Wrong argument, launch app with no arguments for help" << std::endl;
+
+				return false;
+			}
+			else
+			{
+				options.paths.push_back( argv[idx] );
+			}
+		}
+
+		const size_t pathCount = options.mode == Mode::Local ? 2 : options.mode == Mode::Daemon ? 1 : 3;
+		if ( options.paths.size() != pathCount )
 		{
-			std::cout << "Error: Wrong block size format, launch app with no arguments for help" << std::endl;
+			std::cout << "Error: Wrong number of arguments, launch app with no arguments for help" << std::endl;
 
-			return 1;
+			return false;
 		}
 
-		if ( blockSize > 64 * inMegabytes || blockSize < 1024 )
+		if ( options.mode != Mode::Daemon && !std::strcmp( options.paths.back(), "-" ) )
+		{
+			console = &std::cerr;
+		}
+
+		return true;
+	}
+
+#if !defined( _WIN32 )
+	Signature::Service::Daemon* runningDaemon = nullptr;
+
+	void stopDaemon( int )
+	{
+		if ( runningDaemon )
+			runningDaemon->stop();
+	}
+#endif // !_WIN32
+
+	int runLocal( const options_t& options )
+	{
+#if defined( _WIN32 )
+		if ( console == &std::cerr )
 		{
-			std::cout << "Error: Wrong block size, launch app with no arguments for help" << std::endl;
+			_setmode( _fileno( stdout ), _O_BINARY );
+		}
+#endif // _WIN32
+
+		auto start = std::chrono::high_resolution_clock::now();
+		Signature::MainWorker worker( options.paths[0], options.paths[1], options.blockSize, options.maxMemory, options.readerCount );
+		int exitCode = worker.execute();
+		auto stop = std::chrono::high_resolution_clock::now();
+
+		*console << "Done, time: " << std::chrono::duration_cast<std::chrono::seconds>( stop - start ).count() << " sec" << std::endl;
+
+		return exitCode;
+	}
+
+	int runDaemon( const options_t& options )
+	{
+#if !defined( _WIN32 )
+		Signature::Service::Daemon daemon( options.paths[0], options.maxMemory, options.readerCount );
+
+		runningDaemon = &daemon;
+		std::signal( SIGINT, stopDaemon );
+		std::signal( SIGTERM, stopDaemon );
+		std::signal( SIGPIPE, SIG_IGN );
 
-			return 1;
+		std::cout << "Listening on " << options.paths[0] << std::endl;
+
+		try
+		{
+			daemon.run();
 		}
+		catch ( ... )
+		{
+			runningDaemon = nullptr;
+			throw;
+		}
+
+		runningDaemon = nullptr;
+		return 0;
+#else
+		(void)options;
+		std::cout << "Error: Daemon mode isn't supported on this platform" << std::endl;
+
+		return 1;
+#endif // !_WIN32
+	}
+
+	int runClient( const options_t& options )
+	{
+#if !defined( _WIN32 )
+		Signature::Service::Client client( options.paths[0] );
+		client.sign( options.paths[1], options.paths[2], options.blockSize, options.passDescriptor );
+
+		return 0;
+#else
+		(void)options;
+		std::cout << "Error: Client mode isn't supported on this platform" << std::endl;
+
+		return 1;
+#endif // !_WIN32
+	}
+} // namespace
+
+int main( int argc, char* argv[] )
+{
+	if ( argc < 2 )
+	{
+		printUsage();
+
+		return 0;
+	}
+
+	options_t options;
+	if ( !parseOptions( argc, argv, options ) )
+	{
+		return 1;
 	}
 
 	int exitCode = 1;
 
 	try
 	{
-		auto start = std::chrono::high_resolution_clock::now();
-		Signature::MainWorker worker( argv[1], argv[2], blockSize );
-		exitCode = worker.execute();
-		auto stop = std::chrono::high_resolution_clock::now();
+		switch ( options.mode )
+		{
+			case Mode::Local:
+				exitCode = runLocal( options );
+				break;
 
-		std::cout << "Done, time: " << std::chrono::duration_cast<std::chrono::seconds>( stop - start ).count() << " sec" << std::endl;
+			case Mode::Daemon:
+				exitCode = runDaemon( options );
+				break;
+
+			case Mode::Client:
+				exitCode = runClient( options );
+				break;
+		}
 	}
 	catch ( const std::exception& e )
 	{
-		std::cout << "Error: " << e.what() << std::endl;
+		*console << "Error: " << e.what() << std::endl;
 	}
 	catch ( ... )
 	{
-		std::cout << "Unknown error" << std::endl;
+		*console << "Unknown error" << std::endl;
 	}
 
 	return exitCode;
@@ -1,15 +1,21 @@
 #pragma once
 
 #include <vector>
+#include <cstdint>
 #include <memory>
 
 namespace Signature
 {
 	using buffer_t = std::vector<uint8_t>;
 
+	struct job_data_t;
+	using job_data_ptr_t = std::shared_ptr<job_data_t>;
+
 	struct chunk_data_t
 	{
-		size_t blockIndex = 0;
+		job_data_ptr_t job;
+		size_t blockIndex = 0; // first block of the chunk
+		size_t blockCount = 0;
 		buffer_t rawData;
 
 		chunk_data_t( size_t reservedSize ) :
@@ -18,8 +24,9 @@ namespace Signature
 
 	struct result_data_t
 	{
-		size_t blockIndex = 0;
-		uint32_t hashSum = 0;
+		job_data_ptr_t job;
+		size_t blockIndex = 0; // block of the first hash sum
+		std::vector<uint32_t> hashSums;
 	};
 
 	using chunk_data_ptr_t = std::unique_ptr<chunk_data_t>;